@@ -1,19 +1,59 @@
 #include "Mixer.h"
 
 Mixer::Mixer()
+    : sampleKit(std::make_unique<SampleKit>())
 {
-    // Initialize all channels with default pan gains
-    for (auto& channel : channels)
-    {
-        channel.updatePanGains();
-    }
 }
 
 Mixer::~Mixer() = default;
 
 void Mixer::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    // Nothing special needed for basic volume/pan
+    // Anything queued while stopped is applied before the audio thread takes over the queue
+    applyPendingParameterChanges();
+    
+    {
+        // Decode and resample every drum sample once, so playback is a plain read
+        const juce::ScopedLock sl(sampleKitLock);
+        
+        for (auto& voice : voices)
+            voice.stop();
+        
+        sampleKit = createSampleKit(sampleRate);
+        audioSampleKit = sampleKit.get();
+    }
+    
+    const juce::ScopedLock configScope(configLock);
+    currentSampleRate = sampleRate;
+    currentBlockSize = samplesPerBlock;
+    
+    {
+        const juce::ScopedLock sl(insertLock);
+        
+        for (auto& channel : channels)
+        {
+            for (auto& insert : channel.inserts)
+                insert->prepare(sampleRate, samplesPerBlock);
+        }
+        
+        updateLatencyCompensation(true);
+    }
+    
+    isPrepared = true;
+}
+
+void Mixer::beginBlock()
+{
+    applyPendingParameterChanges();
+    
+    // Switch to freshly loaded samples. The voices point into the old kit, so they stop.
+    if (auto* newKit = pendingSampleKit.exchange(nullptr))
+    {
+        for (auto& voice : voices)
+            voice.stop();
+        
+        audioSampleKit = newKit;
+    }
 }
 
 void Mixer::processChannelBuffer(int channelIndex, juce::AudioBuffer<float>& buffer, int numSamples)
@@ -21,21 +61,39 @@ void Mixer::processChannelBuffer(int channelIndex, juce::AudioBuffer<float>& buf
     if (channelIndex < 0 || channelIndex >= 8)
         return;
     
-    auto& channel = channels[channelIndex];
+    // Channel 0 starts each block, so existing callers pick up queued changes without calling beginBlock
+    if (channelIndex == 0)
+        beginBlock();
     
-    // Check if channel should be audible
-    bool shouldPlay = !channel.muted && (!anySoloed || channel.soloed);
+    // Inserts are being changed, drop this block rather than wait for them
+    const juce::ScopedTryLock insertScope(insertLock);
     
-    if (!shouldPlay)
+    if (!insertScope.isLocked())
     {
         buffer.clear();
         return;
     }
     
+    auto& channel = channels[channelIndex];
+    
+    // Inserts keep running while muted so their lookahead state stays current
+    for (auto& insert : channel.inserts)
+        insert->process(buffer, numSamples);
+    
+    // Check if channel should be audible
+    bool shouldPlay = !channel.muted.load() && (!hasAnySoloedChannels() || channel.soloed.load());
+    
     // Apply volume and pan
-    float finalVolume = channel.volume * masterVolume;
+    float finalVolume = channel.volume.load() * masterVolume.load();
+    
+    float leftGain, rightGain;
+    ChannelStrip::getPanGains(channel.pan.load(), leftGain, rightGain);
     
-    if (buffer.getNumChannels() >= 2)
+    if (!shouldPlay)
+    {
+        buffer.clear();
+    }
+    else if (buffer.getNumChannels() >= 2)
     {
         // Stereo processing
         auto* leftChannel = buffer.getWritePointer(0);
@@ -45,8 +103,8 @@ void Mixer::processChannelBuffer(int channelIndex, juce::AudioBuffer<float>& buf
         {
             float monoSample = (leftChannel[sample] + rightChannel[sample]) * 0.5f;
             
-            leftChannel[sample] = monoSample * finalVolume * channel.leftGain;
-            rightChannel[sample] = monoSample * finalVolume * channel.rightGain;
+            leftChannel[sample] = monoSample * finalVolume * leftGain;
+            rightChannel[sample] = monoSample * finalVolume * rightGain;
         }
     }
     else if (buffer.getNumChannels() == 1)
@@ -59,99 +117,423 @@ void Mixer::processChannelBuffer(int channelIndex, juce::AudioBuffer<float>& buf
             monoChannel[sample] *= finalVolume;
         }
     }
+    
+    // Line this path up with the channel that has the most latency
+    compensationDelays[channelIndex].process(buffer, numSamples);
 }
 
 void Mixer::releaseResources()
 {
-    // Nothing to release for basic mixer
+    const juce::ScopedLock configScope(configLock);
+    isPrepared = false;
+    applyPendingParameterChanges();
+    
+    {
+        const juce::ScopedLock sl(sampleKitLock);
+        
+        for (auto& voice : voices)
+            voice.stop();
+        
+        // Frees the decoded audio; the files are kept for the next prepareToPlay
+        audioSampleKit = nullptr;
+        sampleKit = std::make_unique<SampleKit>();
+    }
+    
+    const juce::ScopedLock sl(insertLock);
+    
+    for (auto& channel : channels)
+    {
+        for (auto& insert : channel.inserts)
+            insert->reset();
+    }
+    
+    for (auto& delay : compensationDelays)
+        delay.prepare(0, 0);
+}
+
+void Mixer::addChannelInsert(int channel, std::unique_ptr<ChannelInsert> insert)
+{
+    if (channel < 0 || channel >= 8 || insert == nullptr)
+        return;
+    
+    int previousLatency, newLatency;
+    
+    {
+        const juce::ScopedLock configScope(configLock);
+        const bool prepared = isPrepared.load();
+        previousLatency = totalLatencySamples.load();
+        
+        // Not visible to the audio thread yet, so it can be prepared outside the insert lock
+        if (prepared)
+            insert->prepare(currentSampleRate, currentBlockSize);
+        
+        const juce::ScopedLock sl(insertLock);
+        channels[channel].inserts.push_back(std::move(insert));
+        
+        if (prepared)
+            updateLatencyCompensation(false);
+        
+        newLatency = totalLatencySamples.load();
+    }
+    
+    if (newLatency != previousLatency && onLatencyChanged != nullptr)
+        onLatencyChanged(newLatency);
+}
+
+void Mixer::clearChannelInserts(int channel)
+{
+    if (channel < 0 || channel >= 8)
+        return;
+    
+    int previousLatency, newLatency;
+    std::vector<std::unique_ptr<ChannelInsert>> removed;
+    
+    {
+        const juce::ScopedLock configScope(configLock);
+        previousLatency = totalLatencySamples.load();
+        
+        const juce::ScopedLock sl(insertLock);
+        removed.swap(channels[channel].inserts);
+        
+        if (isPrepared.load())
+            updateLatencyCompensation(false);
+        
+        newLatency = totalLatencySamples.load();
+    }
+    
+    // The removed inserts are destroyed here, after the audio thread can no longer reach them
+    removed.clear();
+    
+    if (newLatency != previousLatency && onLatencyChanged != nullptr)
+        onLatencyChanged(newLatency);
+}
+
+int Mixer::getChannelLatencySamples(int channel) const
+{
+    if (channel >= 0 && channel < 8)
+        return channels[channel].latencySamples.load();
+    return 0;
+}
+
+void Mixer::setChannelSample(int channel, const juce::File& file, bool reloadNow)
+{
+    if (channel >= 0 && channel < 8)
+    {
+        const juce::ScopedLock sl(sampleKitLock);
+        channelSampleFiles[channel] = file;
+        
+        if (reloadNow)
+            reloadSamples();
+    }
+}
+
+bool Mixer::reloadSamples()
+{
+    const juce::ScopedLock sl(sampleKitLock);
+    
+    // Stopped, prepareToPlay loads the current files
+    if (audioSampleKit.load() == nullptr)
+        return true;
+    
+    auto newKit = createSampleKit(sampleKit->cache.getSampleRate());
+    pendingSampleKit = newKit.get();
+    
+    // The old kit may be playing until the audio thread takes the new one
+    for (int i = 0; i < 200 && pendingSampleKit.load() != nullptr; ++i)
+        juce::Thread::sleep(5);
+    
+    // Never taken (e.g. the device stalled), keep the old kit. The files are still
+    // stored, so the next reload or prepareToPlay picks them up.
+    auto* expected = newKit.get();
+    if (pendingSampleKit.compare_exchange_strong(expected, nullptr))
+        return false;
+    
+    sampleKit = std::move(newKit);
+    return true;
+}
+
+std::unique_ptr<Mixer::SampleKit> Mixer::createSampleKit(double sampleRate) const
+{
+    // Register only the samples assigned now, so replaced ones don't linger in the cache
+    auto kit = std::make_unique<SampleKit>();
+    std::array<int, 8> sampleIds;
+    
+    for (int i = 0; i < 8; ++i)
+        sampleIds[i] = channelSampleFiles[i] != juce::File() ? kit->cache.addSample(channelSampleFiles[i]) : -1;
+    
+    kit->cache.prepare(sampleRate);
+    
+    for (int i = 0; i < 8; ++i)
+        kit->channelSamples[i] = kit->cache.getSample(sampleIds[i]);
+    
+    return kit;
+}
+
+void Mixer::triggerChannel(int channel, float velocity)
+{
+    auto* kit = audioSampleKit.load();
+    
+    if (channel >= 0 && channel < 8 && kit != nullptr && kit->channelSamples[channel] != nullptr)
+    {
+        voices[channel].start(kit->channelSamples[channel], juce::jlimit(0.0f, 1.0f, velocity));
+    }
+}
+
+void Mixer::renderChannel(int channelIndex, juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    if (channelIndex < 0 || channelIndex >= 8)
+        return;
+    
+    // The voice reads straight from the cache into the channel input, then the strip processes it in place
+    voices[channelIndex].renderNextBlock(buffer, numSamples);
+    processChannelBuffer(channelIndex, buffer, numSamples);
 }
 
-void Mixer::setChannelVolume(int channel, float volume)
+void Mixer::setChannelVolume(int channel, float volume, bool markChanged)
 {
     if (channel >= 0 && channel < 8)
     {
         channels[channel].volume = juce::jlimit(0.0f, 1.0f, volume);
+        
+        if (markChanged)
+            markDirty(ParameterChange::Type::Volume, channel);
     }
 }
 
-void Mixer::setChannelPan(int channel, float pan)
+void Mixer::setChannelPan(int channel, float pan, bool markChanged)
 {
     if (channel >= 0 && channel < 8)
     {
         channels[channel].pan = juce::jlimit(-1.0f, 1.0f, pan);
-        channels[channel].updatePanGains();
+        
+        if (markChanged)
+            markDirty(ParameterChange::Type::Pan, channel);
     }
 }
 
-void Mixer::setChannelMute(int channel, bool muted)
+void Mixer::setChannelMute(int channel, bool muted, bool markChanged)
 {
     if (channel >= 0 && channel < 8)
     {
         channels[channel].muted = muted;
+        
+        if (markChanged)
+            markDirty(ParameterChange::Type::Mute, channel);
     }
 }
 
-void Mixer::setChannelSolo(int channel, bool soloed)
+void Mixer::setChannelSolo(int channel, bool soloed, bool markChanged)
 {
     if (channel >= 0 && channel < 8)
     {
         channels[channel].soloed = soloed;
-        updateSoloState();
+        
+        if (markChanged)
+            markDirty(ParameterChange::Type::Solo, channel);
     }
 }
 
 float Mixer::getChannelVolume(int channel) const
 {
     if (channel >= 0 && channel < 8)
-        return channels[channel].volume;
+        return channels[channel].volume.load();
     return 0.0f;
 }
 
 float Mixer::getChannelPan(int channel) const
 {
     if (channel >= 0 && channel < 8)
-        return channels[channel].pan;
+        return channels[channel].pan.load();
     return 0.0f;
 }
 
 bool Mixer::isChannelMuted(int channel) const
 {
     if (channel >= 0 && channel < 8)
-        return channels[channel].muted;
+        return channels[channel].muted.load();
     return false;
 }
 
 bool Mixer::isChannelSoloed(int channel) const
 {
     if (channel >= 0 && channel < 8)
-        return channels[channel].soloed;
+        return channels[channel].soloed.load();
     return false;
 }
 
 bool Mixer::hasAnySoloedChannels() const
 {
-    return anySoloed;
+    // Worked out from the flags each time, a cached copy could go stale when two threads toggle solo
+    for (const auto& channel : channels)
+    {
+        if (channel.soloed.load())
+            return true;
+    }
+    return false;
 }
 
-void Mixer::setMasterVolume(float volume)
+void Mixer::setMasterVolume(float volume, bool markChanged)
 {
     masterVolume = juce::jlimit(0.0f, 1.0f, volume);
+    
+    if (markChanged)
+        markDirty(ParameterChange::Type::MasterVolume, 0);
 }
 
-void Mixer::updateSoloState()
+bool Mixer::pushParameterChange(const ParameterChange& change)
 {
-    anySoloed = false;
-    for (const auto& channel : channels)
+    // No audio thread to drain the queue, the setters are safe to call from here
+    if (!isPrepared.load())
+    {
+        applyParameterChange(change);
+        return true;
+    }
+    
+    const auto scope = parameterFifo.write(1);
+    
+    if (scope.blockSize1 > 0)
+        parameterQueue[(size_t)scope.startIndex1] = change;
+    else if (scope.blockSize2 > 0)
+        parameterQueue[(size_t)scope.startIndex2] = change;
+    else
+    {
+        // The audio thread should empty this every block, so it's stalled or far too small
+        jassertfalse;
+        return false;
+    }
+    
+    return true;
+}
+
+bool Mixer::hasPendingParameterChanges() const
+{
+    return parameterFifo.getNumReady() > 0;
+}
+
+void Mixer::applyPendingParameterChanges()
+{
+    const int numReady = parameterFifo.getNumReady();
+    if (numReady == 0)
+        return;
+    
+    const auto scope = parameterFifo.read(numReady);
+    
+    for (int i = 0; i < scope.blockSize1; ++i)
+        applyParameterChange(parameterQueue[(size_t)(scope.startIndex1 + i)]);
+    
+    for (int i = 0; i < scope.blockSize2; ++i)
+        applyParameterChange(parameterQueue[(size_t)(scope.startIndex2 + i)]);
+}
+
+void Mixer::applyParameterChange(const ParameterChange& change)
+{
+    switch (change.type)
+    {
+        case ParameterChange::Type::Volume:       setChannelVolume(change.channel, change.value); break;
+        case ParameterChange::Type::Pan:          setChannelPan(change.channel, change.value); break;
+        case ParameterChange::Type::Mute:         setChannelMute(change.channel, change.value >= 0.5f); break;
+        case ParameterChange::Type::Solo:         setChannelSolo(change.channel, change.value >= 0.5f); break;
+        case ParameterChange::Type::MasterVolume: setMasterVolume(change.value); break;
+    }
+}
+
+int Mixer::getParameterFlag(ParameterChange::Type type, int channel)
+{
+    // Four flags per channel (volume, pan, mute, solo), master volume last
+    if (type == ParameterChange::Type::MasterVolume)
+        return numParameterFlags - 1;
+    
+    return channel * 4 + (int)type;
+}
+
+Mixer::ParameterChange Mixer::getParameterForFlag(int flag)
+{
+    jassert(flag >= 0 && flag < numParameterFlags);
+    
+    ParameterChange parameter;
+    
+    if (flag == numParameterFlags - 1)
+    {
+        parameter.type = ParameterChange::Type::MasterVolume;
+    }
+    else
     {
-        if (channel.soloed)
+        parameter.type = (ParameterChange::Type)(flag % 4);
+        parameter.channel = flag / 4;
+    }
+    
+    return parameter;
+}
+
+void Mixer::markDirty(ParameterChange::Type type, int channel)
+{
+    dirtyParameters.fetch_or((juce::uint64)1 << getParameterFlag(type, channel));
+}
+
+void Mixer::updateLatencyCompensation(bool resetAllDelays)
+{
+    // Work out each path's latency, then delay the others to line up with the slowest
+    int maxLatency = 0;
+    
+    for (auto& channel : channels)
+    {
+        int latency = 0;
+        
+        for (auto& insert : channel.inserts)
+            latency += insert->getLatencySamples();
+        
+        channel.latencySamples = latency;
+        maxLatency = juce::jmax(maxLatency, latency);
+    }
+    
+    for (int i = 0; i < 8; ++i)
+    {
+        // Paths already at the total latency get no delay line at all. Lines that keep
+        // their length keep their contents, so unaffected channels play on uninterrupted.
+        const int delay = maxLatency - channels[i].latencySamples.load();
+        auto& line = compensationDelays[i];
+        
+        if (resetAllDelays || line.delaySamples != delay || line.ring.getNumChannels() != 2)
+            line.prepare(2, delay);
+    }
+    
+    totalLatencySamples = maxLatency;
+}
+
+void Mixer::CompensationDelay::prepare(int numChannels, int delayToUse)
+{
+    delaySamples = juce::jmax(0, delayToUse);
+    position = 0;
+    
+    ring.setSize(numChannels, delaySamples);
+    ring.clear();
+}
+
+void Mixer::CompensationDelay::process(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    if (delaySamples == 0)
+        return;
+    
+    const int numChannels = juce::jmin(buffer.getNumChannels(), ring.getNumChannels());
+    int done = 0;
+    
+    // Swapping with the ring outputs the delayed samples and stores the new ones in one pass
+    while (done < numSamples)
+    {
+        const int chunk = juce::jmin(numSamples - done, delaySamples - position);
+        
+        for (int i = 0; i < numChannels; ++i)
         {
-            anySoloed = true;
-            break;
+            auto* io = buffer.getWritePointer(i) + done;
+            std::swap_ranges(io, io + chunk, ring.getWritePointer(i) + position);
         }
+        
+        done += chunk;
+        position = (position + chunk) % delaySamples;
     }
 }
 
-void Mixer::ChannelStrip::updatePanGains()
+void Mixer::ChannelStrip::getPanGains(float pan, float& leftGain, float& rightGain)
 {
     // Equal power pan law
     float panRadians = pan * juce::MathConstants<float>::halfPi * 0.5f;
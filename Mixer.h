@@ -3,6 +3,25 @@
 
 #include <JuceHeader.h>
 #include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "SampleCache.h"
+
+// Processing stage on a channel strip, e.g. a lookahead compressor or an oversampled saturator
+class ChannelInsert
+{
+public:
+    virtual ~ChannelInsert() = default;
+    
+    virtual void prepare(double sampleRate, int maximumBlockSize) = 0;
+    virtual void process(juce::AudioBuffer<float>& buffer, int numSamples) = 0;
+    virtual void reset() {}
+    
+    // Delay this stage adds to the signal, read in prepareToPlay and when inserts change
+    virtual int getLatencySamples() const = 0;
+};
 
 class Mixer
 {
@@ -11,14 +30,36 @@ public:
     ~Mixer();
     
     void prepareToPlay(double sampleRate, int samplesPerBlock);
+    void beginBlock();   // Also run by processChannelBuffer for channel 0, callers don't need to call it
     void processChannelBuffer(int channelIndex, juce::AudioBuffer<float>& buffer, int numSamples);
     void releaseResources();
     
-    // Channel controls
-    void setChannelVolume(int channel, float volume);     // 0.0 to 1.0
-    void setChannelPan(int channel, float pan);           // -1.0 to 1.0
-    void setChannelMute(int channel, bool muted);
-    void setChannelSolo(int channel, bool soloed);
+    // Cached drum samples, decoded and resampled in prepareToPlay. While playing, a sample
+    // change decodes a new cache on the calling thread (never the audio thread) and the
+    // audio thread switches to it at the start of its next block. Pass reloadNow = false
+    // when changing several pads, then call reloadSamples() once.
+    void setChannelSample(int channel, const juce::File& file, bool reloadNow = true);
+    bool reloadSamples();   // False if the audio thread didn't pick up the new samples in time
+    void triggerChannel(int channel, float velocity);   // Audio thread
+    void renderChannel(int channelIndex, juce::AudioBuffer<float>& buffer, int numSamples);
+    const SampleCache& getSampleCache() const { return sampleKit->cache; }   // Message thread
+    
+    // Channel inserts, run pre-fader. Every channel is delayed to match the one with the
+    // most latency. Inserts can be changed while playing; only delay lines whose length
+    // changes are rebuilt, and onLatencyChanged is called on the calling thread if the
+    // total latency moved.
+    void addChannelInsert(int channel, std::unique_ptr<ChannelInsert> insert);
+    void clearChannelInserts(int channel);
+    int getChannelLatencySamples(int channel) const;
+    int getTotalLatencySamples() const { return totalLatencySamples.load(); }   // Report this to the host
+    std::function<void(int)> onLatencyChanged;
+    
+    // Channel controls. The GUI passes markChanged = false for its own edits, so
+    // they aren't echoed back into the controls that made them.
+    void setChannelVolume(int channel, float volume, bool markChanged = true);     // 0.0 to 1.0
+    void setChannelPan(int channel, float pan, bool markChanged = true);           // -1.0 to 1.0
+    void setChannelMute(int channel, bool muted, bool markChanged = true);
+    void setChannelSolo(int channel, bool soloed, bool markChanged = true);
     
     // Getters
     float getChannelVolume(int channel) const;
@@ -28,29 +69,102 @@ public:
     bool hasAnySoloedChannels() const;
     
     // Master controls
-    void setMasterVolume(float volume);
-    float getMasterVolume() const { return masterVolume; }
+    void setMasterVolume(float volume, bool markChanged = true);
+    float getMasterVolume() const { return masterVolume.load(); }
+    
+    // Lock-free parameter changes from a non-GUI control thread (single producer).
+    // Changes are applied on the audio thread in beginBlock, before channel 0 is processed,
+    // so every channel in a block sees the same state.
+    // While the mixer isn't prepared there's no audio thread, so they're applied straight away.
+    struct ParameterChange
+    {
+        enum class Type { Volume, Pan, Mute, Solo, MasterVolume };
+        
+        Type type = Type::Volume;
+        int channel = 0;
+        float value = 0.0f;
+    };
+    
+    bool pushParameterChange(const ParameterChange& change);   // false if the queue is full
+    bool hasPendingParameterChanges() const;
+    void applyPendingParameterChanges();
+    
+    // Setters mark their parameter dirty, from whichever thread they run on.
+    // The UI takes the whole set at once and only refreshes what changed.
+    static constexpr int numParameterFlags = 8 * 4 + 1;
+    static int getParameterFlag(ParameterChange::Type type, int channel);
+    static ParameterChange getParameterForFlag(int flag);   // Type and channel, value left at 0
+    juce::uint64 takeDirtyParameters() { return dirtyParameters.exchange(0); }
     
 private:
     struct ChannelStrip
     {
-        float volume = 0.8f;        // Default 80%
-        float pan = 0.0f;           // Center
-        bool muted = false;
-        bool soloed = false;
+        // Set from the GUI and the audio thread, read by control surface feedback
+        std::atomic<float> volume { 0.8f };     // Default 80%
+        std::atomic<float> pan { 0.0f };        // Center
+        std::atomic<bool> muted { false };
+        std::atomic<bool> soloed { false };
+        
+        std::vector<std::unique_ptr<ChannelInsert>> inserts;
+        std::atomic<int> latencySamples { 0 };
         
         // Pan law calculation
-        float leftGain = 1.0f;
-        float rightGain = 1.0f;
+        static void getPanGains(float pan, float& leftGain, float& rightGain);
+    };
+    
+    // Ring buffer that delays a channel up to the mixer's total latency.
+    // Sized in prepareToPlay, never allocates while processing.
+    struct CompensationDelay
+    {
+        juce::AudioBuffer<float> ring;
+        int delaySamples = 0;
+        int position = 0;
         
-        void updatePanGains();
+        void prepare(int numChannels, int delayToUse);
+        void process(juce::AudioBuffer<float>& buffer, int numSamples);
     };
     
     std::array<ChannelStrip, 8> channels;
-    float masterVolume = 0.8f;
-    bool anySoloed = false;
+    std::atomic<float> masterVolume { 0.8f };
+    
+    std::atomic<juce::uint64> dirtyParameters { 0 };
+    std::atomic<bool> isPrepared { false };
+    
+    // Guards the insert chains and delay lines. The audio thread only ever tries it,
+    // so changing inserts can never block audio.
+    juce::CriticalSection insertLock;
+    std::array<CompensationDelay, 8> compensationDelays;
+    std::atomic<int> totalLatencySamples { 0 };
+    
+    // Held by prepareToPlay, releaseResources and insert changes, so an insert is
+    // always prepared with the settings the mixer is actually running at
+    juce::CriticalSection configLock;
+    double currentSampleRate = 0.0;
+    int currentBlockSize = 0;
+    
+    // A prepared cache and the sample each channel plays from it. The message thread owns
+    // the current kit, the audio thread only switches to a new one in beginBlock.
+    struct SampleKit
+    {
+        SampleCache cache;
+        std::array<const SampleCache::CachedSample*, 8> channelSamples {};
+    };
+    
+    juce::CriticalSection sampleKitLock;
+    std::array<juce::File, 8> channelSampleFiles;
+    std::unique_ptr<SampleKit> sampleKit;
+    std::atomic<SampleKit*> audioSampleKit { nullptr };     // nullptr while stopped
+    std::atomic<SampleKit*> pendingSampleKit { nullptr };
+    std::array<SampleCache::Voice, 8> voices;
+    
+    static constexpr int parameterQueueSize = 256;
+    juce::AbstractFifo parameterFifo { parameterQueueSize };
+    std::array<ParameterChange, parameterQueueSize> parameterQueue;
     
-    void updateSoloState();
+    void applyParameterChange(const ParameterChange& change);
+    void markDirty(ParameterChange::Type type, int channel);
+    void updateLatencyCompensation(bool resetAllDelays);
+    std::unique_ptr<SampleKit> createSampleKit(double sampleRate) const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Mixer)
 };
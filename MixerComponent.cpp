@@ -83,10 +83,21 @@ void CustomSlider::mouseDrag(const juce::MouseEvent& event)
     }
 }
 
+void CustomSlider::setDisplayValue(double newValue)
+{
+    setValue(newValue, juce::dontSendNotification);
+    
+    int previousFrame = currentFrame;
+    updateFrameFromValue();
+    
+    if (currentFrame != previousFrame)
+        repaint();
+}
+
 void CustomSlider::updateFrameFromValue()
 {
     // Convert slider value (0.0-1.0) to frame number (30-0, inverted)
-    currentFrame = 30 - (int)(getValue() * 30.0f);
+    currentFrame = 30 - juce::roundToInt(getValue() * 30.0);
     currentFrame = juce::jlimit(0, 30, currentFrame);
 }
 
@@ -190,6 +201,9 @@ MixerComponent::MixerComponent()
     masterVolumeLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
     masterVolumeLabel.setFont(juce::FontOptions(10.0f));
     addAndMakeVisible(masterVolumeLabel);
+    
+    // Picks up mixer changes made outside the GUI (automation, recall, remote control)
+    startTimerHz(30);
 }
 
 MixerComponent::~MixerComponent() = default;
@@ -265,36 +279,24 @@ void MixerComponent::sliderValueChanged(juce::Slider* slider)
     
     auto componentID = slider->getComponentID();
     
+    // Edits made here are already on screen, so they don't mark the mixer's dirty flags
     if (componentID.startsWith("vol_"))
     {
         int channel = componentID.substring(4).getIntValue();
-        mixer->setChannelVolume(channel, (float)slider->getValue());
-        
-        // Update volume label
-        int volumePercent = (int)(slider->getValue() * 100);
-        channelStrips[channel]->volumeLabel.setText(juce::String(volumePercent), juce::dontSendNotification);
+        mixer->setChannelVolume(channel, (float)slider->getValue(), false);
+        updateVolumeLabel(channel, (float)slider->getValue());
     }
     else if (componentID.startsWith("pan_"))
     {
         int channel = componentID.substring(4).getIntValue();
         float panValue = ((float)slider->getValue() - 0.5f) * 2.0f; // Convert 0-1 to -1 to 1
-        mixer->setChannelPan(channel, panValue);
-        
-        // Update pan label
-        if (panValue < -0.1f)
-            channelStrips[channel]->panLabel.setText("L" + juce::String((int)(panValue * -50)), juce::dontSendNotification);
-        else if (panValue > 0.1f)
-            channelStrips[channel]->panLabel.setText("R" + juce::String((int)(panValue * 50)), juce::dontSendNotification);
-        else
-            channelStrips[channel]->panLabel.setText("C", juce::dontSendNotification);
+        mixer->setChannelPan(channel, panValue, false);
+        updatePanLabel(channel, panValue);
     }
     else if (componentID == "master_vol")
     {
-        mixer->setMasterVolume((float)slider->getValue());
-        
-        // Update master volume label
-        int volumePercent = (int)(slider->getValue() * 100);
-        masterVolumeLabel.setText(juce::String(volumePercent), juce::dontSendNotification);
+        mixer->setMasterVolume((float)slider->getValue(), false);
+        updateMasterVolumeLabel((float)slider->getValue());
     }
 }
 
@@ -307,12 +309,12 @@ void MixerComponent::buttonClicked(juce::Button* button)
     if (componentID.startsWith("mute_"))
     {
         int channel = componentID.substring(5).getIntValue();
-        mixer->setChannelMute(channel, button->getToggleState());
+        mixer->setChannelMute(channel, button->getToggleState(), false);
     }
     else if (componentID.startsWith("solo_"))
     {
         int channel = componentID.substring(5).getIntValue();
-        mixer->setChannelSolo(channel, button->getToggleState());
+        mixer->setChannelSolo(channel, button->getToggleState(), false);
     }
 }
 
@@ -320,16 +322,88 @@ void MixerComponent::updateDisplayValues()
 {
     if (mixer == nullptr) return;
     
-    // Update all channel controls to match mixer state
-    for (int i = 0; i < 8; ++i)
+    // Everything is refreshed below, so drop what the timer would otherwise redo
+    mixer->takeDirtyParameters();
+    
+    for (int flag = 0; flag < Mixer::numParameterFlags; ++flag)
+        updateParameterDisplay(flag);
+}
+
+void MixerComponent::timerCallback()
+{
+    if (mixer == nullptr) return;
+    
+    // Only the controls whose parameters changed since the last tick are touched
+    auto dirty = mixer->takeDirtyParameters();
+    
+    for (int flag = 0; dirty != 0; ++flag, dirty >>= 1)
     {
-        auto& strip = *channelStrips[i];
+        if ((dirty & 1) != 0)
+            updateParameterDisplay(flag);
+    }
+}
+
+void MixerComponent::updateParameterDisplay(int parameterFlag)
+{
+    using Type = Mixer::ParameterChange::Type;
+    
+    const auto parameter = Mixer::getParameterForFlag(parameterFlag);
+    
+    if (parameter.type == Type::MasterVolume)
+    {
+        masterVolumeSlider->setDisplayValue(mixer->getMasterVolume());
+        updateMasterVolumeLabel(mixer->getMasterVolume());
+        return;
+    }
+    
+    int channel = parameter.channel;
+    auto& strip = *channelStrips[channel];
+    
+    switch (parameter.type)
+    {
+        case Type::Volume:
+            strip.volumeSlider->setDisplayValue(mixer->getChannelVolume(channel));
+            updateVolumeLabel(channel, mixer->getChannelVolume(channel));
+            break;
+        
+        case Type::Pan:
+            strip.panSlider->setDisplayValue((mixer->getChannelPan(channel) + 1.0f) * 0.5f); // Convert -1 to 1 to 0-1
+            updatePanLabel(channel, mixer->getChannelPan(channel));
+            break;
+        
+        case Type::Mute:
+            strip.muteButton.setToggleState(mixer->isChannelMuted(channel), juce::dontSendNotification);
+            break;
         
-        strip.volumeSlider->setValue(mixer->getChannelVolume(i), juce::dontSendNotification);
-        strip.panSlider->setValue((mixer->getChannelPan(i) + 1.0f) * 0.5f, juce::dontSendNotification); // Convert -1 to 1 to 0-1
-        strip.muteButton.setToggleState(mixer->isChannelMuted(i), juce::dontSendNotification);
-        strip.soloButton.setToggleState(mixer->isChannelSoloed(i), juce::dontSendNotification);
+        case Type::Solo:
+            strip.soloButton.setToggleState(mixer->isChannelSoloed(channel), juce::dontSendNotification);
+            break;
+        
+        default:
+            break;
     }
+}
+
+void MixerComponent::updateVolumeLabel(int channel, float volume)
+{
+    int volumePercent = (int)(volume * 100);
+    channelStrips[channel]->volumeLabel.setText(juce::String(volumePercent), juce::dontSendNotification);
+}
+
+void MixerComponent::updatePanLabel(int channel, float pan)
+{
+    auto& panLabel = channelStrips[channel]->panLabel;
     
-    masterVolumeSlider->setValue(mixer->getMasterVolume(), juce::dontSendNotification);
+    if (pan < -0.1f)
+        panLabel.setText("L" + juce::String((int)(pan * -50)), juce::dontSendNotification);
+    else if (pan > 0.1f)
+        panLabel.setText("R" + juce::String((int)(pan * 50)), juce::dontSendNotification);
+    else
+        panLabel.setText("C", juce::dontSendNotification);
+}
+
+void MixerComponent::updateMasterVolumeLabel(float volume)
+{
+    int volumePercent = (int)(volume * 100);
+    masterVolumeLabel.setText(juce::String(volumePercent), juce::dontSendNotification);
 }
@@ -17,6 +17,9 @@ public:
     void mouseDown(const juce::MouseEvent& event) override;
     void mouseDrag(const juce::MouseEvent& event) override;
     
+    // Moves the slider to a value set elsewhere, without notifying listeners
+    void setDisplayValue(double newValue);
+    
 private:
     juce::Image sliderFrames;
     int currentFrame = 15; // Start at middle position (frame 15 of 31)
@@ -29,7 +32,8 @@ private:
 
 class MixerComponent : public juce::Component,
                       public juce::Slider::Listener,
-                      public juce::Button::Listener
+                      public juce::Button::Listener,
+                      private juce::Timer
 {
 public:
     MixerComponent();
@@ -72,6 +76,11 @@ private:
     Mixer* mixer = nullptr;
     
     void updateDisplayValues();
+    void timerCallback() override;
+    void updateParameterDisplay(int parameterFlag);
+    void updateVolumeLabel(int channel, float volume);
+    void updatePanLabel(int channel, float pan);
+    void updateMasterVolumeLabel(float volume);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MixerComponent)
 };
@@ -0,0 +1,319 @@
+#include "MixerOscInput.h"
+
+namespace
+{
+    constexpr int maxPacketSize = 4096;
+    constexpr float notYetSent = -2.0f; // Outside every parameter range, forces the first send
+    constexpr juce::uint32 maxFeedbackHoldMs = 250;
+    
+    // OSC strings are null terminated and padded to a multiple of 4 bytes.
+    // Returns the offset just past the padding, or -1 if the string is malformed.
+    int readOscString(const char* data, int size, int offset, juce::String& result)
+    {
+        for (int i = offset; i < size; ++i)
+        {
+            if (data[i] == 0)
+            {
+                result = juce::String::fromUTF8(data + offset, i - offset);
+                return juce::jmin(size, (i + 4) & ~3);
+            }
+        }
+        
+        return -1;
+    }
+    
+    void writeOscString(juce::MemoryOutputStream& out, const juce::String& text)
+    {
+        const auto numBytes = text.getNumBytesAsUTF8();
+        out.write(text.toRawUTF8(), numBytes);
+        
+        for (size_t i = numBytes; i < ((numBytes + 4) & ~(size_t)3); ++i)
+            out.writeByte(0);
+    }
+    
+    float readOscFloat(const char* data)
+    {
+        const auto bits = juce::ByteOrder::bigEndianInt(data);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+MixerOscInput::MixerOscInput(Mixer& mixerToControl)
+    : juce::Thread("Mixer OSC Input"),
+      mixer(mixerToControl)
+{
+    lastSentValues.fill(notYetSent);
+}
+
+MixerOscInput::~MixerOscInput()
+{
+    stop();
+}
+
+bool MixerOscInput::start(int portNumber, const juce::String& localInterface)
+{
+    stop();
+    
+    socket = std::make_unique<juce::DatagramSocket>(false);
+    
+    if (!socket->bindToPort(portNumber, localInterface))
+    {
+        socket.reset();
+        return false;
+    }
+    
+    lastSentValues.fill(notYetSent);
+    lastFeedbackTime = 0;
+    feedbackHeldSince = 0;
+    
+    return startThread(juce::Thread::Priority::high);
+}
+
+void MixerOscInput::stop()
+{
+    stopThread(500);
+    socket.reset();
+}
+
+void MixerOscInput::setFeedbackTarget(const juce::String& hostName, int portNumber)
+{
+    // Only read by the receiver thread, so it must not be running
+    jassert(!isThreadRunning());
+    
+    feedbackHost = hostName;
+    feedbackPort = portNumber;
+}
+
+void MixerOscInput::setFeedbackRate(double updatesPerSecond)
+{
+    feedbackIntervalMs = juce::roundToInt(1000.0 / juce::jlimit(1.0, 1000.0, updatesPerSecond));
+}
+
+void MixerOscInput::run()
+{
+    juce::HeapBlock<char> buffer(maxPacketSize);
+    
+    while (!threadShouldExit())
+    {
+        // Short timeout so feedback keeps flowing while the surface is idle
+        if (socket->waitUntilReady(true, 5) == 1)
+        {
+            juce::String senderHost;
+            int senderPort = 0;
+            
+            const int bytesRead = socket->read(buffer, maxPacketSize, false, senderHost, senderPort);
+            
+            if (bytesRead > 0)
+            {
+                lastSenderHost = senderHost;
+                lastSenderPort = senderPort;
+                
+                handlePacket(buffer, bytesRead);
+            }
+        }
+        
+        sendFeedbackIfDue();
+    }
+}
+
+void MixerOscInput::handlePacket(const char* data, int size)
+{
+    if (size >= 16 && std::memcmp(data, "#bundle", 8) == 0)
+    {
+        // Bundle: 8 byte tag, 8 byte time tag, then size-prefixed elements.
+        // Time tags are ignored, everything is applied immediately.
+        int offset = 16;
+        
+        while (offset + 4 <= size)
+        {
+            const int elementSize = (int)juce::ByteOrder::bigEndianInt(data + offset);
+            offset += 4;
+            
+            if (elementSize <= 0 || elementSize > size - offset)
+                break;
+            
+            handlePacket(data + offset, elementSize);
+            offset += elementSize;
+        }
+        
+        return;
+    }
+    
+    if (size > 0 && data[0] == '/')
+        handleMessage(data, size);
+}
+
+void MixerOscInput::handleMessage(const char* data, int size)
+{
+    juce::String address, typeTags;
+    
+    int offset = readOscString(data, size, 0, address);
+    if (offset < 0)
+        return;
+    
+    offset = readOscString(data, size, offset, typeTags);
+    if (offset < 0 || typeTags.length() < 2 || !typeTags.startsWithChar(','))
+        return;
+    
+    float value = 0.0f;
+    
+    switch (typeTags[1])
+    {
+        case 'f':
+            if (size - offset < 4) return;
+            value = readOscFloat(data + offset);
+            break;
+        
+        case 'i':
+            if (size - offset < 4) return;
+            value = (float)(juce::int32)juce::ByteOrder::bigEndianInt(data + offset);
+            break;
+        
+        case 'T': value = 1.0f; break;
+        case 'F': value = 0.0f; break;
+        default:  return;
+    }
+    
+    if (!std::isfinite(value))
+        return;
+    
+    auto tokens = juce::StringArray::fromTokens(address, "/", "");
+    tokens.removeEmptyStrings();
+    
+    if (tokens.size() != 3 || tokens[0] != "mixer")
+        return;
+    
+    Mixer::ParameterChange change;
+    
+    if (tokens[1] == "master")
+    {
+        if (tokens[2] != "volume")
+            return;
+        
+        change.type = Mixer::ParameterChange::Type::MasterVolume;
+        change.value = juce::jlimit(0.0f, 1.0f, value);
+    }
+    else
+    {
+        if (!tokens[1].containsOnly("0123456789"))
+            return;
+        
+        change.channel = tokens[1].getIntValue() - 1;
+        if (change.channel < 0 || change.channel >= 8)
+            return;
+        
+        if (tokens[2] == "volume")
+        {
+            change.type = Mixer::ParameterChange::Type::Volume;
+            change.value = juce::jlimit(0.0f, 1.0f, value);
+        }
+        else if (tokens[2] == "pan")
+        {
+            change.type = Mixer::ParameterChange::Type::Pan;
+            change.value = juce::jlimit(-1.0f, 1.0f, value);
+        }
+        else if (tokens[2] == "mute")
+        {
+            change.type = Mixer::ParameterChange::Type::Mute;
+            change.value = value >= 0.5f ? 1.0f : 0.0f;
+        }
+        else if (tokens[2] == "solo")
+        {
+            change.type = Mixer::ParameterChange::Type::Solo;
+            change.value = value >= 0.5f ? 1.0f : 0.0f;
+        }
+        else
+        {
+            return;
+        }
+    }
+    
+    if (!mixer.pushParameterChange(change))
+        return;
+    
+    // The surface already shows this value, don't echo it back
+    lastSentValues[(size_t)Mixer::getParameterFlag(change.type, change.channel)] = change.value;
+}
+
+void MixerOscInput::sendFeedbackIfDue()
+{
+    const auto now = juce::Time::getMillisecondCounter();
+    if (now - lastFeedbackTime < (juce::uint32)feedbackIntervalMs.load())
+        return;
+    
+    lastFeedbackTime = now;
+    
+    const bool useLastSender = feedbackHost.isEmpty();
+    const auto& host = useLastSender ? lastSenderHost : feedbackHost;
+    const int port = useLastSender ? lastSenderPort : feedbackPort;
+    
+    if (host.isEmpty() || port <= 0)
+        return;
+    
+    // Surface changes still waiting for the audio thread would be echoed back stale.
+    // Only wait a little though, the audio device may have stopped with changes queued.
+    if (mixer.hasPendingParameterChanges())
+    {
+        if (feedbackHeldSince == 0)
+            feedbackHeldSince = now;
+        
+        if (now - feedbackHeldSince < maxFeedbackHoldMs)
+            return;
+    }
+    
+    feedbackHeldSince = 0;
+    
+    for (int flag = 0; flag < Mixer::numParameterFlags; ++flag)
+    {
+        const float value = getParameterValue(flag);
+        
+        if (value == lastSentValues[(size_t)flag])
+            continue;
+        
+        juce::MemoryOutputStream message(64);
+        writeOscString(message, getParameterAddress(flag));
+        writeOscString(message, ",f");
+        message.writeFloatBigEndian(value);
+        
+        socket->write(host, port, message.getData(), (int)message.getDataSize());
+        lastSentValues[(size_t)flag] = value;
+    }
+}
+
+float MixerOscInput::getParameterValue(int parameterFlag) const
+{
+    using Type = Mixer::ParameterChange::Type;
+    
+    const auto parameter = Mixer::getParameterForFlag(parameterFlag);
+    
+    switch (parameter.type)
+    {
+        case Type::Volume:       return mixer.getChannelVolume(parameter.channel);
+        case Type::Pan:          return mixer.getChannelPan(parameter.channel);
+        case Type::Mute:         return mixer.isChannelMuted(parameter.channel) ? 1.0f : 0.0f;
+        case Type::Solo:         return mixer.isChannelSoloed(parameter.channel) ? 1.0f : 0.0f;
+        case Type::MasterVolume: return mixer.getMasterVolume();
+    }
+    
+    return 0.0f;
+}
+
+juce::String MixerOscInput::getParameterAddress(int parameterFlag) const
+{
+    using Type = Mixer::ParameterChange::Type;
+    
+    const auto parameter = Mixer::getParameterForFlag(parameterFlag);
+    
+    switch (parameter.type)
+    {
+        case Type::Volume: return "/mixer/" + juce::String(parameter.channel + 1) + "/volume";
+        case Type::Pan:    return "/mixer/" + juce::String(parameter.channel + 1) + "/pan";
+        case Type::Mute:   return "/mixer/" + juce::String(parameter.channel + 1) + "/mute";
+        case Type::Solo:   return "/mixer/" + juce::String(parameter.channel + 1) + "/solo";
+        case Type::MasterVolume: break;
+    }
+    
+    return "/mixer/master/volume";
+}
@@ -0,0 +1,69 @@
+#ifndef MIXEROSCINPUT_H_INCLUDED
+#define MIXEROSCINPUT_H_INCLUDED
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include "Mixer.h"
+
+// OSC-over-UDP control surface input for the Mixer.
+//
+// Packets are received and decoded on a dedicated thread and pushed straight into
+// the Mixer's lock-free parameter queue, so fader moves never wait on the message
+// thread. Supported addresses (channels are 1-8, as labelled in the mixer):
+//
+//   /mixer/<n>/volume  f  0.0 to 1.0
+//   /mixer/<n>/pan     f  -1.0 to 1.0
+//   /mixer/<n>/mute    i/f/T/F
+//   /mixer/<n>/solo    i/f/T/F
+//   /mixer/master/volume f
+//
+// Mixer state is sent back to the surface on the same addresses, limited to the
+// feedback rate and only for values that actually changed. The GUI catches up
+// through the Mixer's dirty flags, which MixerComponent polls from its timer.
+class MixerOscInput : private juce::Thread
+{
+public:
+    explicit MixerOscInput(Mixer& mixerToControl);
+    ~MixerOscInput() override;
+    
+    // Binds the UDP port (e.g. 9000) and starts the receiver thread. Only this machine
+    // can reach it by default; pass another interface address (or "" for all of them)
+    // to accept a surface on the network.
+    bool start(int portNumber, const juce::String& localInterface = "127.0.0.1");
+    void stop();
+    bool isReceiving() const { return isThreadRunning(); }
+    
+    // Where feedback is sent. Call before start(); if no host is set, feedback goes
+    // back to the address and port of the last packet received.
+    void setFeedbackTarget(const juce::String& hostName, int portNumber);
+    void setFeedbackRate(double updatesPerSecond);
+    
+private:
+    Mixer& mixer;
+    std::unique_ptr<juce::DatagramSocket> socket;
+    
+    juce::String feedbackHost;
+    int feedbackPort = 0;
+    juce::String lastSenderHost;
+    int lastSenderPort = 0;
+    
+    std::atomic<int> feedbackIntervalMs { 50 };
+    juce::uint32 lastFeedbackTime = 0;
+    juce::uint32 feedbackHeldSince = 0;
+    std::array<float, Mixer::numParameterFlags> lastSentValues;   // Indexed by Mixer::getParameterFlag
+    
+    void run() override;
+    
+    void handlePacket(const char* data, int size);
+    void handleMessage(const char* data, int size);
+    
+    void sendFeedbackIfDue();
+    float getParameterValue(int parameterFlag) const;
+    juce::String getParameterAddress(int parameterFlag) const;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MixerOscInput)
+};
+
+#endif // MIXEROSCINPUT_H_INCLUDED
@@ -0,0 +1,353 @@
+#include "SampleCache.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t arenaAlignment = 64;   // Cache line, also enough for any SIMD width
+    constexpr int framesPerAlignment = (int)(arenaAlignment / sizeof(float));
+    
+    // Resampler kernel: zero crossings per side, table steps per crossing, and the
+    // cutoff as a fraction of the lower Nyquist (leaves room for the transition band)
+    constexpr int resamplerZeroCrossings = 32;
+    constexpr int resamplerTableResolution = 512;
+    constexpr double resamplerCutoff = 0.95;
+    
+    int getAlignedLength(int numFrames)
+    {
+        return (numFrames + framesPerAlignment - 1) / framesPerAlignment * framesPerAlignment;
+    }
+    
+    bool hasSameContent(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+            return false;
+        
+        for (int channel = 0; channel < a.getNumChannels(); ++channel)
+        {
+            if (std::memcmp(a.getReadPointer(channel), b.getReadPointer(channel), (size_t)a.getNumSamples() * sizeof(float)) != 0)
+                return false;
+        }
+        
+        return true;
+    }
+}
+
+// ============================================================================
+// Voice Implementation
+// ============================================================================
+
+void SampleCache::Voice::start(const CachedSample* sampleToPlay, float gainToUse) noexcept
+{
+    sample = sampleToPlay;
+    gain = gainToUse;
+    position = 0;
+}
+
+void SampleCache::Voice::renderNextBlock(juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    if (sample == nullptr)
+        return;
+    
+    const int numToRender = juce::jmin(numSamples, buffer.getNumSamples(), sample->numFrames - position);
+    
+    if (buffer.getNumChannels() >= 2)
+    {
+        // Mono samples go to both sides, the strip's pan law takes it from there
+        const auto* left = sample->channels[0] + position;
+        const auto* right = sample->channels[sample->numChannels > 1 ? 1 : 0] + position;
+        
+        juce::FloatVectorOperations::addWithMultiply(buffer.getWritePointer(0), left, gain, numToRender);
+        juce::FloatVectorOperations::addWithMultiply(buffer.getWritePointer(1), right, gain, numToRender);
+    }
+    else if (buffer.getNumChannels() == 1)
+    {
+        const float channelGain = sample->numChannels > 1 ? gain * 0.5f : gain;
+        
+        for (int channel = 0; channel < sample->numChannels; ++channel)
+            juce::FloatVectorOperations::addWithMultiply(buffer.getWritePointer(0), sample->channels[channel] + position, channelGain, numToRender);
+    }
+    
+    position += numToRender;
+    
+    if (position >= sample->numFrames)
+        sample = nullptr;
+}
+
+// ============================================================================
+// SampleCache Implementation
+// ============================================================================
+
+SampleCache::SampleCache()
+{
+    formatManager.registerBasicFormats();
+}
+
+SampleCache::~SampleCache() = default;
+
+int SampleCache::addSample(const juce::File& file)
+{
+    const int existing = sourceFiles.indexOf(file);
+    if (existing >= 0)
+    {
+        sourceUseCounts.getReference(existing)++;
+        return existing;
+    }
+    
+    sourceFiles.add(file);
+    sourceUseCounts.add(1);
+    return sourceFiles.size() - 1;
+}
+
+void SampleCache::clear()
+{
+    release();
+    sourceFiles.clear();
+    sourceUseCounts.clear();
+}
+
+void SampleCache::prepare(double sampleRate)
+{
+    release();
+    preparedSampleRate = sampleRate;
+    
+    struct DecodedSample
+    {
+        juce::AudioBuffer<float> audio;
+        juce::uint64 hash = 0;
+        double sampleRate = 0.0;
+    };
+    
+    std::vector<DecodedSample> uniqueSamples;
+    entryForSource.assign((size_t)sourceFiles.size(), -1);
+    
+    for (int i = 0; i < sourceFiles.size(); ++i)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(sourceFiles[i]));
+        
+        if (reader == nullptr || reader->lengthInSamples <= 0 || reader->lengthInSamples > std::numeric_limits<int>::max())
+            continue;
+        
+        const int numChannels = juce::jmin(2, (int)reader->numChannels);
+        const int length = (int)reader->lengthInSamples;
+        
+        juce::AudioBuffer<float> decoded(numChannels, length);
+        reader->read(&decoded, 0, length, 0, true, numChannels > 1);
+        
+        // Identical audio is only resampled and stored once
+        const auto hash = hashContent(decoded, reader->sampleRate);
+        
+        auto match = std::find_if(uniqueSamples.begin(), uniqueSamples.end(), [&](const DecodedSample& candidate)
+        {
+            return candidate.hash == hash
+                && candidate.sampleRate == reader->sampleRate
+                && hasSameContent(candidate.audio, decoded);
+        });
+        
+        if (match != uniqueSamples.end())
+        {
+            entryForSource[(size_t)i] = (int)std::distance(uniqueSamples.begin(), match);
+            continue;
+        }
+        
+        entryForSource[(size_t)i] = (int)uniqueSamples.size();
+        uniqueSamples.push_back({ std::move(decoded), hash, reader->sampleRate });
+    }
+    
+    // Resample what's left, then lay everything out in one aligned block
+    std::vector<juce::AudioBuffer<float>> converted;
+    converted.reserve(uniqueSamples.size());
+    
+    size_t totalFloats = 0;
+    
+    for (auto& decoded : uniqueSamples)
+    {
+        converted.push_back(resample(decoded.audio, decoded.sampleRate, sampleRate));
+        decoded.audio.setSize(0, 0);
+        
+        totalFloats += (size_t)converted.back().getNumChannels() * (size_t)getAlignedLength(converted.back().getNumSamples());
+    }
+    
+    arenaBytes = totalFloats * sizeof(float);
+    arenaStorage.allocate(arenaBytes + arenaAlignment, true);
+    
+    auto* arena = juce::snapPointerToAlignment(reinterpret_cast<float*>(arenaStorage.get()), arenaAlignment);
+    
+    entries.resize(converted.size());
+    
+    for (size_t i = 0; i < converted.size(); ++i)
+    {
+        auto& entry = entries[i];
+        entry.numChannels = converted[i].getNumChannels();
+        entry.numFrames = converted[i].getNumSamples();
+        
+        for (int channel = 0; channel < entry.numChannels; ++channel)
+        {
+            juce::FloatVectorOperations::copy(arena, converted[i].getReadPointer(channel), entry.numFrames);
+            entry.channels[channel] = arena;
+            arena += getAlignedLength(entry.numFrames);
+        }
+    }
+    
+    // Every use beyond the first of an entry, whether the same file or identical audio
+    // in another file, would otherwise have been a separate copy
+    std::vector<int> entryUses(entries.size(), 0);
+    
+    for (size_t i = 0; i < entryForSource.size(); ++i)
+    {
+        if (entryForSource[i] >= 0)
+            entryUses[(size_t)entryForSource[i]] += sourceUseCounts[(int)i];
+    }
+    
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const size_t entryBytes = (size_t)entries[i].numChannels * (size_t)getAlignedLength(entries[i].numFrames) * sizeof(float);
+        bytesSavedByDeduplication += (size_t)juce::jmax(0, entryUses[i] - 1) * entryBytes;
+    }
+}
+
+void SampleCache::release()
+{
+    entries.clear();
+    entryForSource.clear();
+    arenaStorage.free();
+    arenaBytes = 0;
+    bytesSavedByDeduplication = 0;
+    preparedSampleRate = 0.0;
+}
+
+const SampleCache::CachedSample* SampleCache::getSample(int sampleId) const
+{
+    if (sampleId < 0 || sampleId >= (int)entryForSource.size())
+        return nullptr;
+    
+    const int entryIndex = entryForSource[(size_t)sampleId];
+    return entryIndex >= 0 ? &entries[(size_t)entryIndex] : nullptr;
+}
+
+SampleCache::MemoryUsage SampleCache::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    usage.numUnique = (int)entries.size();
+    
+    for (int i = 0; i < sourceFiles.size(); ++i)
+    {
+        usage.numRegistered += sourceUseCounts[i];
+        
+        if (i < (int)entryForSource.size() && entryForSource[(size_t)i] < 0)
+            usage.numFailed += sourceUseCounts[i];
+    }
+    
+    usage.arenaBytes = arenaBytes;
+    usage.bytesSavedByDeduplication = bytesSavedByDeduplication;
+    return usage;
+}
+
+juce::String SampleCache::getMemoryReport() const
+{
+    const auto usage = getMemoryUsage();
+    
+    juce::String report;
+    report << usage.numRegistered << " samples in use, " << usage.numUnique << " unique";
+    
+    if (usage.numFailed > 0)
+        report << ", " << usage.numFailed << " failed to load";
+    
+    report << " - " << juce::File::descriptionOfSizeInBytes((juce::int64)usage.arenaBytes)
+           << " at " << juce::String(preparedSampleRate, 0) << " Hz, "
+           << juce::File::descriptionOfSizeInBytes((juce::int64)usage.bytesSavedByDeduplication) << " saved by sharing duplicates";
+    
+    return report;
+}
+
+juce::AudioBuffer<float> SampleCache::resample(const juce::AudioBuffer<float>& source, double sourceRate, double targetRate)
+{
+    if (sourceRate <= 0.0 || targetRate <= 0.0 || sourceRate == targetRate)
+        return source;
+    
+    // Band-limited sinc interpolation evaluated at each output's exact source position.
+    // The kernel is symmetric, so there is no latency to trim and no fractional offset.
+    const double speedRatio = sourceRate / targetRate;
+    
+    // When downsampling the cutoff follows the target Nyquist, which widens the kernel
+    const double cutoff = juce::jmin(1.0, 1.0 / speedRatio) * resamplerCutoff;
+    const double halfWidth = resamplerZeroCrossings / cutoff;
+    
+    // Blackman-windowed sinc, tabulated over one side at a fine resolution
+    const int tableSize = resamplerZeroCrossings * resamplerTableResolution;
+    std::vector<float> kernel((size_t)tableSize + 2, 0.0f);
+    
+    for (int i = 0; i <= tableSize; ++i)
+    {
+        const double x = (double)i / resamplerTableResolution;
+        const double sinc = i == 0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+        const double phase = juce::MathConstants<double>::pi * x / resamplerZeroCrossings;
+        const double window = 0.42 + 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+        
+        kernel[(size_t)i] = (float)(sinc * window * cutoff);
+    }
+    
+    const int sourceLength = source.getNumSamples();
+    const int outputLength = (int)std::ceil(sourceLength / speedRatio);
+    
+    juce::AudioBuffer<float> result(source.getNumChannels(), outputLength);
+    
+    for (int channel = 0; channel < source.getNumChannels(); ++channel)
+    {
+        const auto* input = source.getReadPointer(channel);
+        auto* output = result.getWritePointer(channel);
+        
+        for (int n = 0; n < outputLength; ++n)
+        {
+            const double position = n * speedRatio;
+            const int first = juce::jmax(0, (int)std::ceil(position - halfWidth));
+            const int last = juce::jmin(sourceLength - 1, (int)std::floor(position + halfWidth));
+            
+            double sum = 0.0;
+            
+            for (int i = first; i <= last; ++i)
+            {
+                const double tablePosition = std::abs(position - i) * cutoff * resamplerTableResolution;
+                const int index = (int)tablePosition;
+                
+                if (index >= tableSize)
+                    continue;
+                
+                const double fraction = tablePosition - index;
+                const double weight = kernel[(size_t)index] + fraction * (kernel[(size_t)index + 1] - kernel[(size_t)index]);
+                
+                sum += input[i] * weight;
+            }
+            
+            output[n] = (float)sum;
+        }
+    }
+    
+    return result;
+}
+
+juce::uint64 SampleCache::hashContent(const juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    // 64-bit FNV-1a over the format and the raw sample data
+    juce::uint64 hash = 14695981039346656037ull;
+    
+    auto addBytes = [&hash](const void* data, size_t numBytes)
+    {
+        const auto* bytes = static_cast<const juce::uint8*>(data);
+        
+        for (size_t i = 0; i < numBytes; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    
+    const int numChannels = buffer.getNumChannels();
+    addBytes(&numChannels, sizeof(numChannels));
+    addBytes(&sampleRate, sizeof(sampleRate));
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+        addBytes(buffer.getReadPointer(channel), (size_t)buffer.getNumSamples() * sizeof(float));
+    
+    return hash;
+}
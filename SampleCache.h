@@ -0,0 +1,87 @@
+#ifndef SAMPLECACHE_H_INCLUDED
+#define SAMPLECACHE_H_INCLUDED
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Drum samples decoded and resampled to the device rate ahead of playback.
+//
+// Samples are registered from the message thread, then prepare() decodes every
+// file once, converts it with a band-limited sinc resampler and stores the result in
+// a single aligned arena. Identical audio (e.g. the same kick in two kits) is
+// detected by content hash and only stored once.
+class SampleCache
+{
+public:
+    struct CachedSample
+    {
+        const float* channels[2] = { nullptr, nullptr };
+        int numChannels = 0;
+        int numFrames = 0;
+    };
+    
+    // Plays a cached sample by reading straight from the arena into a channel buffer
+    class Voice
+    {
+    public:
+        void start(const CachedSample* sampleToPlay, float gainToUse) noexcept;
+        void stop() noexcept { sample = nullptr; }
+        bool isActive() const noexcept { return sample != nullptr; }
+        
+        // Adds the next numSamples of the sample into the buffer
+        void renderNextBlock(juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+    
+    private:
+        const CachedSample* sample = nullptr;
+        int position = 0;
+        float gain = 1.0f;
+    };
+    
+    // Counts are per registration, so one file used on two pads counts twice
+    struct MemoryUsage
+    {
+        int numRegistered = 0;
+        int numUnique = 0;
+        int numFailed = 0;
+        size_t arenaBytes = 0;
+        size_t bytesSavedByDeduplication = 0;
+    };
+    
+    SampleCache();
+    ~SampleCache();
+    
+    // Returns an id for the file, takes effect at the next prepare(). Registering the
+    // same file again returns the same id and is counted as another use.
+    int addSample(const juce::File& file);
+    void clear();
+    
+    void prepare(double sampleRate);
+    void release();
+    double getSampleRate() const { return preparedSampleRate; }   // 0 if not prepared
+    
+    // nullptr if the id is unknown, the file failed to load or prepare() hasn't run
+    const CachedSample* getSample(int sampleId) const;
+    
+    MemoryUsage getMemoryUsage() const;
+    juce::String getMemoryReport() const;
+    
+private:
+    juce::AudioFormatManager formatManager;
+    juce::Array<juce::File> sourceFiles;
+    juce::Array<int> sourceUseCounts;
+    
+    std::vector<int> entryForSource;            // -1 if the file couldn't be loaded
+    std::vector<CachedSample> entries;
+    
+    juce::HeapBlock<char> arenaStorage;
+    size_t arenaBytes = 0;
+    size_t bytesSavedByDeduplication = 0;
+    double preparedSampleRate = 0.0;
+    
+    static juce::AudioBuffer<float> resample(const juce::AudioBuffer<float>& source, double sourceRate, double targetRate);
+    static juce::uint64 hashContent(const juce::AudioBuffer<float>& buffer, double sampleRate);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleCache)
+};
+
+#endif // SAMPLECACHE_H_INCLUDED